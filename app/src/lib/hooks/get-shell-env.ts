@@ -2,6 +2,7 @@ import { join } from 'path'
 import { getShell } from './get-shell'
 import { spawn } from 'child_process'
 import { SupportedHooksEnvShell } from './config'
+import { parseFrame } from 'printenvz'
 
 export type ShellEnvResult =
   | {
@@ -13,6 +14,61 @@ export type ShellEnvResult =
       shellKind?: SupportedHooksEnvShell
     }
 
+/** The most recently parsed environment, along with its hash */
+let lastShellEnv:
+  | { readonly hash: string; readonly env: Record<string, string> }
+  | undefined
+
+/**
+ * Finds and parses the first frame written by `printenvz --framed` in the
+ * given output. Returns null if there's no complete frame in it.
+ *
+ * When the environment hasn't changed since the last time it was parsed (i.e.
+ * its hash matches) the records aren't decoded again, and a copy of the
+ * previous environment is returned instead. Callers get their own copy so that
+ * one of them changing it can't affect the others.
+ */
+export const parsePrintenvzOutput = (
+  output: Buffer
+): { env: Record<string, string>; end: number } | null => {
+  const frame = parseFrame(output, lastShellEnv?.hash)
+
+  if (frame === null) {
+    return null
+  }
+
+  if (frame.env !== undefined || lastShellEnv === undefined) {
+    lastShellEnv = { hash: frame.hash, env: frame.env ?? {} }
+  }
+
+  return { env: { ...lastShellEnv.env }, end: frame.end }
+}
+
+/**
+ * Returns the environment and extra arguments to run printenvz with so that it
+ * records its phases when the app itself is traced (i.e. DESKTOP_NATIVE_TRACE
+ * is set), including the time it took to initialize the shell running it.
+ */
+export const getPrintenvzTraceOptions = () => {
+  const tracePath = process.env.DESKTOP_NATIVE_TRACE
+
+  if (!tracePath) {
+    return { env: {}, args: [] }
+  }
+
+  // Wall clock time in microseconds since epoch, like the trace records
+  const spawnTime = Math.round(
+    (performance.timeOrigin + performance.now()) * 1000
+  )
+
+  // This ends up in the environment of hooks too, so they're traced like the
+  // rest of the git processes the app runs.
+  return {
+    env: { DESKTOP_NATIVE_TRACE: tracePath },
+    args: ['--trace-spawn-time', `${spawnTime}`],
+  }
+}
+
 export const getShellEnv = async (
   cwd?: string,
   shellKind?: SupportedHooksEnvShell,
@@ -30,52 +86,38 @@ export const getShellEnv = async (
   const { shell, args, quoteCommand, windowsVerbatimArguments, argv0 } =
     shellInfo
 
+  const trace = getPrintenvzTraceOptions()
+
   return await new Promise((resolve, reject) => {
-    const child = spawn(shell, [...args, quoteCommand(printenvzPath)], {
-      env: {},
-      windowsVerbatimArguments,
-      argv0,
-      stdio: 'pipe',
-      cwd,
-    })
+    const child = spawn(
+      shell,
+      [...args, quoteCommand(printenvzPath, '--framed', ...trace.args)],
+      {
+        env: trace.env,
+        windowsVerbatimArguments,
+        argv0,
+        stdio: 'pipe',
+        cwd,
+      }
+    )
 
     const chunks: Buffer[] = []
 
     child.stdout
       .on('data', chunk => chunks.push(chunk))
       .on('end', () => {
-        const stdout = Buffer.concat(chunks).toString('utf8')
         // It's possible that the user writes to stdout in their shell init
-        // script which would get picked up here so we've added a marker to the
-        // output of printenvz so we can be sure we're only parsing its output
-        const startRe = /--printenvz--begin\r?\n/
-        const endRe = /\r?\n--printenvz--end\r?\n/g
-
-        const startMatch = stdout.match(startRe)
+        // script which would get picked up here, which is why printenvz
+        // writes the environment as a frame we can reliably find and parse
+        const result = parsePrintenvzOutput(Buffer.concat(chunks))
 
-        if (!startMatch || startMatch.index === undefined) {
+        if (result === null) {
           return reject(
-            new Error('could not find start marker in shell output')
+            new Error('could not find printenvz output in shell output')
           )
         }
 
-        const lastEndMatch = [...stdout.matchAll(endRe)].at(-1)
-
-        if (!lastEndMatch) {
-          return reject(new Error('could not find end marker in shell output'))
-        }
-
-        const matches = stdout
-          .substring(
-            startMatch.index + startMatch[0].length,
-            lastEndMatch.index
-          )
-          .matchAll(/([^=]+)=([^\0]*)\0/g)
-
-        resolve({
-          kind: 'success',
-          env: Object.fromEntries(Array.from(matches, m => [m[1], m[2]])),
-        })
+        resolve({ kind: 'success', env: result.env })
       })
 
     child.on('error', err => reject(err))
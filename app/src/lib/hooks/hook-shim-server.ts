@@ -0,0 +1,298 @@
+import { EventEmitter } from 'events'
+import { createServer, Server, Socket } from 'net'
+import { PassThrough, Readable, Writable } from 'stream'
+
+/** Magic number requests from the hook shim start with. */
+const RequestMagic = Buffer.from('DHKS', 'ascii')
+
+/** Version of the hook shim protocol supported by the app. */
+const HookShimProtocolVersion = 1
+
+/** Size of the header (magic number + version byte) of requests. */
+const HeaderLength = RequestMagic.length + 1
+
+/** Size of the length prefix of every field. */
+const LengthPrefixSize = 4
+
+/** A request sent by the hook shim when git runs a hook. */
+export interface IHookShimRequest {
+  readonly token: string
+  /** The name of the hook, i.e. the name the hook shim was invoked as */
+  readonly hookName: string
+  readonly cwd: string
+  readonly isStdinConnected: boolean
+  /** The arguments passed to the hook (excluding the hook path) */
+  readonly args: ReadonlyArray<string>
+  readonly env: Record<string, string>
+}
+
+/**
+ * Tries to decode a request sent by the hook shim. Returns null if the request
+ * hasn't been fully received yet, or the request and the offset right after it
+ * otherwise.
+ *
+ * Throws an error if the header is invalid or the protocol version is not
+ * supported.
+ */
+export function decodeHookShimRequest(
+  data: Buffer
+): { request: IHookShimRequest; end: number } | null {
+  if (data.length < HeaderLength) {
+    return null
+  }
+
+  if (!data.subarray(0, RequestMagic.length).equals(RequestMagic)) {
+    throw new Error('Invalid hook shim request header')
+  }
+
+  const version = data[RequestMagic.length]
+  if (version !== HookShimProtocolVersion) {
+    throw new Error(`Unsupported hook shim protocol version ${version}`)
+  }
+
+  let offset = HeaderLength
+
+  const readLength = () => {
+    if (data.length - offset < LengthPrefixSize) {
+      return null
+    }
+
+    const length = data.readUInt32BE(offset)
+    offset += LengthPrefixSize
+    return length
+  }
+
+  const readField = () => {
+    const length = readLength()
+    if (length === null || data.length - offset < length) {
+      return null
+    }
+
+    const field = data.toString('utf8', offset, offset + length)
+    offset += length
+    return field
+  }
+
+  const readFields = () => {
+    const count = readLength()
+    if (count === null) {
+      return null
+    }
+
+    const fields = new Array<string>()
+    for (let i = 0; i < count; i++) {
+      const field = readField()
+      if (field === null) {
+        return null
+      }
+      fields.push(field)
+    }
+
+    return fields
+  }
+
+  const token = readField()
+  const hookName = token === null ? null : readField()
+  const cwd = hookName === null ? null : readField()
+  const stdinConnected = cwd === null ? null : readField()
+  const args = stdinConnected === null ? null : readFields()
+  const envVars = args === null ? null : readFields()
+
+  if (
+    token === null ||
+    hookName === null ||
+    cwd === null ||
+    stdinConnected === null ||
+    args === null ||
+    envVars === null
+  ) {
+    return null
+  }
+
+  const env: Record<string, string> = {}
+  for (const envVar of envVars) {
+    // On Windows there are variables like "=C:=C:\" whose name starts with '='
+    const separator = envVar.indexOf('=', 1)
+    if (separator !== -1) {
+      env[envVar.substring(0, separator)] = envVar.substring(separator + 1)
+    }
+  }
+
+  return {
+    request: {
+      token,
+      hookName,
+      cwd,
+      isStdinConnected: stdinConnected === '1',
+      args,
+      env,
+    },
+    end: offset,
+  }
+}
+
+/** Encodes a message sent to the hook shim. */
+function encodeMessage(type: 'o' | 'e' | 'x', payload: Buffer) {
+  const header = Buffer.alloc(1 + LengthPrefixSize)
+  header.write(type, 0, 'ascii')
+  header.writeUInt32BE(payload.length, 1)
+  return Buffer.concat([header, payload])
+}
+
+/**
+ * A connection from the hook shim, i.e. a git hook being run. The hook's stdin
+ * is streamed to `stdin`, and anything written to `stdout` or `stderr` is
+ * streamed to the hook shim right away.
+ */
+export class HookShimConnection extends EventEmitter {
+  public readonly stdin: Readable
+  public readonly stdout: Writable
+  public readonly stderr: Writable
+
+  private readonly stdinStream = new PassThrough()
+  private pending = Buffer.alloc(0)
+  private stdinFinished = false
+
+  public constructor(
+    private readonly socket: Socket,
+    public readonly request: IHookShimRequest
+  ) {
+    super()
+
+    this.stdin = this.stdinStream
+    this.stdout = this.createOutputStream('o')
+    this.stderr = this.createOutputStream('e')
+
+    socket.on('close', () => {
+      this.stdinStream.end()
+      this.emit('close')
+    })
+  }
+
+  public get hookName() {
+    return this.request.hookName
+  }
+
+  public get args() {
+    return this.request.args
+  }
+
+  public get env() {
+    return this.request.env
+  }
+
+  public get cwd() {
+    return this.request.cwd
+  }
+
+  public get isStdinConnected() {
+    return this.request.isStdinConnected
+  }
+
+  /** Takes data received from the hook shim after the request. */
+  public pushStdin(chunk: Buffer) {
+    if (this.stdinFinished) {
+      return
+    }
+
+    this.pending =
+      this.pending.length > 0 ? Buffer.concat([this.pending, chunk]) : chunk
+
+    while (this.pending.length >= LengthPrefixSize) {
+      const length = this.pending.readUInt32BE(0)
+
+      if (length === 0) {
+        this.stdinFinished = true
+        this.pending = Buffer.alloc(0)
+        this.stdinStream.end()
+        return
+      }
+
+      if (this.pending.length < LengthPrefixSize + length) {
+        return
+      }
+
+      this.stdinStream.write(
+        this.pending.subarray(LengthPrefixSize, LengthPrefixSize + length)
+      )
+      this.pending = this.pending.subarray(LengthPrefixSize + length)
+    }
+  }
+
+  /** Makes the hook shim exit with the given code, ending the connection. */
+  public exit(exitCode: number) {
+    return new Promise<void>((resolve, reject) => {
+      if (this.socket.destroyed || !this.socket.writable) {
+        return reject(new Error('hook shim connection is closed'))
+      }
+
+      const payload = Buffer.alloc(LengthPrefixSize)
+      payload.writeInt32BE(exitCode, 0)
+      this.socket.end(encodeMessage('x', payload), () => resolve())
+    })
+  }
+
+  private createOutputStream(type: 'o' | 'e') {
+    return new Writable({
+      write: (chunk: Buffer, _encoding, callback) => {
+        if (this.socket.destroyed || !this.socket.writable) {
+          return callback(new Error('hook shim connection is closed'))
+        }
+
+        this.socket.write(encodeMessage(type, chunk), callback)
+      },
+    })
+  }
+}
+
+/**
+ * Creates a server for the hook shim to connect to. The connection callback is
+ * only invoked once the whole request has been received, and only for requests
+ * with a valid token.
+ */
+export function createHookShimServer(
+  onConnection: (connection: HookShimConnection) => void,
+  validateToken: (token: string) => boolean
+): Server {
+  return createServer(socket => {
+    let received = Buffer.alloc(0)
+    let connection: HookShimConnection | null = null
+
+    socket.on('error', err => {
+      log.debug(`hooks: hook shim connection error`, err)
+      socket.destroy()
+    })
+
+    socket.on('data', (chunk: Buffer) => {
+      if (connection !== null) {
+        connection.pushStdin(chunk)
+        return
+      }
+
+      received = received.length > 0 ? Buffer.concat([received, chunk]) : chunk
+
+      let decoded
+      try {
+        decoded = decodeHookShimRequest(received)
+      } catch (e) {
+        log.error(`hooks: invalid hook shim request`, e)
+        socket.destroy()
+        return
+      }
+
+      if (decoded === null) {
+        return
+      }
+
+      if (!validateToken(decoded.request.token)) {
+        log.error(`hooks: hook shim request with invalid token`)
+        socket.destroy()
+        return
+      }
+
+      connection = new HookShimConnection(socket, decoded.request)
+      onConnection(connection)
+      connection.pushStdin(received.subarray(decoded.end))
+    })
+  })
+}
@@ -1,6 +1,6 @@
 import { spawn } from 'child_process'
-import { basename, resolve } from 'path'
-import { ProcessProxyConnection as Connection } from 'process-proxy'
+import { resolve } from 'path'
+import { HookShimConnection as Connection } from './hook-shim-server'
 import type { HookCallbackOptions } from '../git'
 import { resolveGitBinary } from 'dugite'
 import { ShellEnvResult } from './get-shell-env'
@@ -71,12 +71,13 @@ export const createHooksProxy = (
 ) => {
   return async (conn: Connection) => {
     const startTime = Date.now()
-    const proxyArgs = await conn.getArgs()
-    const proxyEnv = await conn.getEnv()
-    const proxyCwd = await conn.getCwd()
-    const hasStdin = await conn.isStdinConnected()
-
-    const hookName = basename(proxyArgs[0], __WIN32__ ? '.exe' : undefined)
+    const {
+      hookName,
+      args: proxyArgs,
+      env: proxyEnv,
+      cwd: proxyCwd,
+      isStdinConnected: hasStdin,
+    } = conn
 
     const abortController = new AbortController()
     const abort = () => abortController.abort()
@@ -112,7 +113,7 @@ export const createHooksProxy = (
       ...(hookName === 'pre-auto-gc' ? ['--ignore-missing'] : []),
       ...(hasStdin ? ['--to-stdin=/dev/stdin'] : []),
       '--',
-      ...proxyArgs.slice(1),
+      ...proxyArgs,
     ]
 
     const terminalOutput: Buffer[] = []
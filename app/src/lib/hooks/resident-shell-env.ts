@@ -0,0 +1,446 @@
+import { ChildProcess, spawn } from 'child_process'
+import { readdir, stat } from 'fs/promises'
+import { homedir } from 'os'
+import { join } from 'path'
+import { getShell } from './get-shell'
+import { SupportedHooksEnvShell } from './config'
+import {
+  getPrintenvzTraceOptions,
+  getShellEnv,
+  parsePrintenvzOutput,
+  ShellEnvResult,
+} from './get-shell-env'
+
+const pongMarker = Buffer.from('--printenvz--pong\n')
+const errorMarker = Buffer.from('--printenvz--error')
+
+type PendingRequest = {
+  readonly kind: 'ping' | 'env'
+  readonly resolve: (env: Record<string, string | undefined>) => void
+  readonly reject: (error: Error) => void
+}
+
+/**
+ * Directories whose scripts are sourced by the system-wide profiles. The
+ * directories themselves are included so that adding or removing a script
+ * changes the fingerprint too.
+ */
+const shellConfigDirectories = ['/etc/profile.d']
+
+/**
+ * Files read by tools like direnv, nvm or asdf from the shell configuration to
+ * set up the environment of a specific directory.
+ */
+const directoryConfigFiles = [
+  '.envrc',
+  '.nvmrc',
+  '.node-version',
+  '.tool-versions',
+]
+
+/**
+ * The maximum number of resident shells kept alive at once. Since there's one
+ * per directory, the least recently used one is stopped to make room for a
+ * new one.
+ */
+const MaxResidentShells = 4
+
+/**
+ * Returns the shell configuration files that could affect the environment
+ * produced by a login/interactive shell in the given directory. We don't try to
+ * figure out which of them the user's shell actually reads, it's cheaper to
+ * just stat all of them.
+ */
+const getShellConfigFiles = async (cwd: string) => {
+  const home = homedir()
+  const zdotdir = process.env.ZDOTDIR ?? home
+
+  const files = [
+    join(home, '.profile'),
+    join(home, '.bash_profile'),
+    join(home, '.bash_login'),
+    join(home, '.bashrc'),
+    join(zdotdir, '.zshenv'),
+    join(zdotdir, '.zprofile'),
+    join(zdotdir, '.zshrc'),
+    join(zdotdir, '.zlogin'),
+    join(home, '.config', 'fish', 'config.fish'),
+    ...directoryConfigFiles.map(f => join(cwd, f)),
+  ]
+
+  if (__WIN32__) {
+    return files
+  }
+
+  files.push(
+    '/etc/profile',
+    '/etc/bashrc',
+    '/etc/bash.bashrc',
+    '/etc/zshenv',
+    '/etc/zprofile',
+    '/etc/zshrc',
+    '/etc/zlogin'
+  )
+
+  for (const dir of shellConfigDirectories) {
+    const entries = await readdir(dir).catch(() => [])
+    files.push(dir, ...entries.sort().map(f => join(dir, f)))
+  }
+
+  return files
+}
+
+/**
+ * Returns a string that changes whenever any of the shell configuration files
+ * is created, removed or modified.
+ */
+const getShellConfigFingerprint = async (cwd: string) => {
+  const entries = await Promise.all(
+    (await getShellConfigFiles(cwd)).map(file =>
+      stat(file).then(
+        s => `${file}:${s.mtimeMs}:${s.size}`,
+        () => `${file}:-`
+      )
+    )
+  )
+
+  return entries.join('\n')
+}
+
+/**
+ * A login/interactive shell running printenvz in resident mode, which answers
+ * requests for environment snapshots over its stdin/stdout without having to
+ * go through the (potentially slow) shell initialization again.
+ */
+class ResidentShell {
+  private output = Buffer.alloc(0)
+  private readonly pending = new Array<PendingRequest>()
+  private exited = false
+
+  public constructor(
+    private readonly child: ChildProcess,
+    public readonly fingerprint: string,
+    onExit: () => void
+  ) {
+    child.stdout?.on('data', (chunk: Buffer) => this.onData(chunk))
+    child.on('error', error => this.onExit(error, onExit))
+    child.on('close', (code, signal) =>
+      this.onExit(
+        new Error(`resident shell exited with code ${code} and signal ${signal}`),
+        onExit
+      )
+    )
+    // The stdin pipe might be closed by the time we write to it
+    child.stdin?.on('error', () => {})
+
+    this.updateRef()
+  }
+
+  public get hasExited() {
+    return this.exited
+  }
+
+  /** Resolves once printenvz is up and running (i.e. shell init is done) */
+  public async ping() {
+    await this.send('ping', 'ping')
+  }
+
+  /** Returns a snapshot of the shell's environment with PWD set to cwd */
+  public getEnv(cwd: string) {
+    return this.send('env', `env ${cwd}`)
+  }
+
+  public dispose() {
+    if (!this.exited) {
+      this.child.stdin?.end('exit\0')
+    }
+  }
+
+  private send(kind: PendingRequest['kind'], command: string) {
+    return new Promise<Record<string, string | undefined>>(
+      (resolve, reject) => {
+        if (this.exited || !this.child.stdin) {
+          return reject(new Error('resident shell is not running'))
+        }
+
+        this.pending.push({ kind, resolve, reject })
+        this.updateRef()
+        this.child.stdin.write(`${command}\0`)
+      }
+    )
+  }
+
+  /**
+   * Only keep the app (or the test runner) alive because of the resident shell
+   * while there are requests in flight.
+   */
+  private updateRef() {
+    const stdout = this.child.stdout as { ref?(): void; unref?(): void } | null
+
+    if (this.pending.length > 0) {
+      this.child.ref()
+      stdout?.ref?.()
+    } else {
+      this.child.unref()
+      stdout?.unref?.()
+    }
+  }
+
+  private onData(chunk: Buffer) {
+    this.output =
+      this.output.length > 0 ? Buffer.concat([this.output, chunk]) : chunk
+
+    while (this.pending.length > 0 && this.processResponse()) {
+      this.updateRef()
+    }
+  }
+
+  /**
+   * Tries to process the response to the oldest pending request. Returns
+   * true if it could be processed, false if more output is needed.
+   */
+  private processResponse(): boolean {
+    const request = this.pending[0]
+
+    if (request.kind === 'ping') {
+      // Anything before the pong is output from the shell initialization
+      const index = this.output.indexOf(pongMarker)
+      if (index === -1) {
+        return false
+      }
+
+      this.output = this.output.subarray(index + pongMarker.length)
+      this.pending.shift()
+      request.resolve({})
+      return true
+    }
+
+    const errorIndex = this.output.indexOf(errorMarker)
+    if (errorIndex === 0) {
+      const newline = this.output.indexOf('\n')
+      if (newline === -1) {
+        return false
+      }
+
+      const message = this.output.subarray(0, newline).toString('utf8')
+      this.output = this.output.subarray(newline + 1)
+      this.pending.shift()
+      request.reject(new Error(message))
+      return true
+    }
+
+    const result = parsePrintenvzOutput(this.output)
+    if (result === null) {
+      return false
+    }
+
+    this.output = this.output.subarray(result.end)
+    this.pending.shift()
+    request.resolve(result.env)
+    return true
+  }
+
+  private onExit(error: Error, onExit: () => void) {
+    if (this.exited) {
+      return
+    }
+
+    this.exited = true
+    onExit()
+
+    for (const request of this.pending.splice(0)) {
+      request.reject(error)
+    }
+
+    this.updateRef()
+  }
+}
+
+type ResidentShellEntry = {
+  readonly fingerprint: string
+  readonly shell: Promise<ResidentShell | undefined>
+}
+
+const residentShells = new Map<string, ResidentShellEntry>()
+
+/** Processes of all the resident shells that haven't exited yet */
+const residentShellProcesses = new Set<ChildProcess>()
+
+/**
+ * Kills the resident shells synchronously, since there's no time to wait for
+ * them to exit gracefully when the app is quitting.
+ */
+const killResidentShells = () => {
+  for (const child of residentShellProcesses) {
+    child.kill()
+  }
+  residentShellProcesses.clear()
+}
+
+// Resident shells would otherwise outlive the app. The renderer doesn't
+// reliably emit the process exit event, so unloading the window counts too.
+process.once('exit', killResidentShells)
+if (typeof window !== 'undefined') {
+  window.addEventListener('unload', killResidentShells)
+}
+
+const startResidentShell = async (
+  key: string,
+  cwd: string,
+  fingerprint: string,
+  shellKind: SupportedHooksEnvShell | undefined,
+  printenvzPath: string
+): Promise<ResidentShell | undefined> => {
+  const shellInfo = await getShell(shellKind)
+
+  if (!shellInfo) {
+    return undefined
+  }
+
+  const { shell, args, quoteCommand, windowsVerbatimArguments, argv0 } =
+    shellInfo
+
+  const trace = getPrintenvzTraceOptions()
+  const child = spawn(
+    shell,
+    [
+      ...args,
+      quoteCommand(printenvzPath, '--resident', '--framed', ...trace.args),
+    ],
+    {
+      env: trace.env,
+      windowsVerbatimArguments,
+      argv0,
+      // Nobody would read the shell's stderr, and a chatty shell configuration
+      // could fill the pipe and block the shell.
+      stdio: ['pipe', 'pipe', 'ignore'],
+      cwd,
+    }
+  )
+
+  residentShellProcesses.add(child)
+  child.once('close', () => residentShellProcesses.delete(child))
+
+  const residentShell: ResidentShell = new ResidentShell(
+    child,
+    fingerprint,
+    () => {
+      const entry = residentShells.get(key)
+      entry?.shell.then(s => {
+        if (s === residentShell && residentShells.get(key) === entry) {
+          residentShells.delete(key)
+        }
+      })
+    }
+  )
+
+  const startTime = Date.now()
+  await residentShell.ping()
+  log.debug(`hooks: started resident shell in ${Date.now() - startTime}ms`)
+
+  return residentShell
+}
+
+/** Stops the least recently used resident shells beyond the limit */
+const trimResidentShells = () => {
+  for (const [key, entry] of residentShells) {
+    if (residentShells.size <= MaxResidentShells) {
+      break
+    }
+
+    residentShells.delete(key)
+    entry.shell.then(s => s?.dispose())
+  }
+}
+
+/**
+ * Returns the environment of the user's shell for the given directory, like
+ * `getShellEnv`, but using a resident shell that stays alive between calls so
+ * the cost of the shell initialization is only paid once.
+ *
+ * Since the shell initialization can depend on the directory (e.g. direnv or
+ * version managers), each directory gets its own resident shell, started in
+ * it. A resident shell is rebuilt whenever the user's shell configuration
+ * files or the directory's configuration files change.
+ *
+ * Falls back to `getShellEnv` for shells that can't run printenvz in resident
+ * mode (PowerShell) or if the resident shell fails.
+ */
+export const getResidentShellEnv = async (
+  cwd: string,
+  shellKind?: SupportedHooksEnvShell,
+  printenvzPath?: string
+): Promise<ShellEnvResult> => {
+  const ext = __WIN32__ ? '.exe' : ''
+  printenvzPath ??= join(__dirname, `printenvz${ext}`)
+
+  // PowerShell runs printenvz via Start-Process, which doesn't let us talk to
+  // it over stdin.
+  if (shellKind === 'powershell' || shellKind === 'pwsh') {
+    return getShellEnv(cwd, shellKind, printenvzPath)
+  }
+
+  const key = `${shellKind ?? 'default'}:${printenvzPath}:${cwd}`
+  const fingerprint = await getShellConfigFingerprint(cwd)
+
+  let entry = residentShells.get(key)
+
+  if (entry !== undefined) {
+    // Keep the map ordered from least to most recently used
+    residentShells.delete(key)
+    residentShells.set(key, entry)
+  }
+
+  if (entry !== undefined && entry.fingerprint !== fingerprint) {
+    log.debug(`hooks: shell configuration changed, restarting resident shell`)
+    entry.shell.then(s => s?.dispose())
+    residentShells.delete(key)
+    entry = undefined
+  }
+
+  if (entry === undefined) {
+    const shell = startResidentShell(
+      key,
+      cwd,
+      fingerprint,
+      shellKind,
+      printenvzPath
+    ).catch(e => {
+      log.warn(`hooks: failed to start resident shell`, e)
+      return undefined
+    })
+    entry = { fingerprint, shell }
+    residentShells.set(key, entry)
+    trimResidentShells()
+  }
+
+  const shell = await entry.shell
+
+  if (shell === undefined) {
+    if (residentShells.get(key) === entry) {
+      residentShells.delete(key)
+    }
+
+    // Either the shell couldn't be found, in which case getShellEnv will report
+    // the failure, or the resident shell didn't work for some reason.
+    return getShellEnv(cwd, shellKind, printenvzPath)
+  }
+
+  try {
+    return { kind: 'success', env: await shell.getEnv(cwd) }
+  } catch (e) {
+    log.warn(`hooks: resident shell failed, falling back`, e)
+    shell.dispose()
+    return getShellEnv(cwd, shellKind, printenvzPath)
+  }
+}
+
+/** Stops all resident shells */
+export const disposeResidentShells = async () => {
+  const entries = [...residentShells.values()]
+  residentShells.clear()
+
+  for (const shell of await Promise.all(entries.map(e => e.shell))) {
+    shell?.dispose()
+  }
+}
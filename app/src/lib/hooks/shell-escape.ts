@@ -68,7 +68,7 @@ export const powershell: Shell = {
   quoteCommand: (cmd, ...args) =>
     `Start-Process -NoNewWindow -Wait -FilePath '${powershellEscape(cmd)}'${
       args.length > 0
-        ? '-ArgumentList ' +
+        ? ' -ArgumentList ' +
           args.map(a => `'${powershellEscape(a)}'`).join(', ')
         : ''
     }`,
@@ -1,13 +1,27 @@
-import { cp, mkdtemp, rm } from 'fs/promises'
+import { rmSync } from 'fs'
+import {
+  cp,
+  link,
+  lstat,
+  mkdir,
+  mkdtemp,
+  readdir,
+  rm,
+  stat,
+  symlink,
+} from 'fs/promises'
 import { AddressInfo } from 'net'
 import { tmpdir } from 'os'
 import { join } from 'path'
-import { createProxyProcessServer } from 'process-proxy'
 import type { IGitExecutionOptions } from '../git/core'
 import { getRepoHooks } from './get-repo-hooks'
 import { createHooksProxy } from './hooks-proxy'
+import { createHookShimServer } from './hook-shim-server'
+import { getDesktopHookShimPath } from '../trampoline/trampoline-environment'
 import { getShellEnv } from './get-shell-env'
+import { getResidentShellEnv } from './resident-shell-env'
 import memoizeOne from 'memoize-one'
+import { isErrnoException } from '../errno-exception'
 import {
   getCacheHooksEnv,
   getGitHookEnvShell,
@@ -26,6 +40,147 @@ const memoizedGetShellEnv = memoizeOne(
   }
 )
 
+/**
+ * Hooks directories, keyed by the hooks they contain. Every hook in them is a
+ * link to the hook shim, which works out which hook it's running as from its
+ * own name, so they can be reused by any git operation (in any repository)
+ * that intercepts the same hooks for as long as the app is running.
+ */
+const hooksDirectories = new Map<string, Promise<string>>()
+
+/**
+ * Directory containing the hooks directories of every app session, each of
+ * them in a directory named after the process that created it. The temporary
+ * directory might be shared with other users, so it's per user.
+ */
+const hooksRoot = join(
+  tmpdir(),
+  __WIN32__ ? 'desktop-git-hooks' : `desktop-git-hooks-${process.getuid?.()}`
+)
+
+const isProcessRunning = (pid: number) => {
+  try {
+    process.kill(pid, 0)
+    return true
+  } catch (e) {
+    // The process exists, we just aren't allowed to signal it
+    return isErrnoException(e) && e.code === 'EPERM'
+  }
+}
+
+/**
+ * Removes the session directories whose process isn't running anymore. They
+ * are normally removed when the app exits, but that doesn't happen if it
+ * crashes or gets killed.
+ */
+const removeStaleSessionDirectories = async () => {
+  const entries = await readdir(hooksRoot).catch(() => [])
+
+  for (const entry of entries) {
+    const pid = parseInt(entry, 10)
+
+    if (!isNaN(pid) && pid !== process.pid && !isProcessRunning(pid)) {
+      await rm(join(hooksRoot, entry), { recursive: true, force: true })
+    }
+  }
+}
+
+/**
+ * Creates the directory of this session in the hooks root, unless the root
+ * can't be trusted (it isn't a directory of ours), in which case it's created
+ * directly in the temporary directory and won't be removed after a crash.
+ */
+const createSessionDirectory = async () => {
+  await mkdir(hooksRoot, { recursive: true, mode: 0o700 })
+  const root = await lstat(hooksRoot)
+  const uid = process.getuid?.()
+
+  if (root.isDirectory() && (uid === undefined || root.uid === uid)) {
+    await removeStaleSessionDirectories().catch(e =>
+      log.warn(`hooks: failed to remove stale hooks directories`, e)
+    )
+    return mkdtemp(join(hooksRoot, `${process.pid}-`))
+  }
+
+  log.warn(`hooks: not using ${hooksRoot}, it doesn't belong to us`)
+  return mkdtemp(join(tmpdir(), `desktop-git-hooks-${process.pid}-`))
+}
+
+/** The directory the hooks directories of this session are created in */
+let sessionDirectory: Promise<string> | undefined
+
+/** Same as `sessionDirectory` once it's been created, to remove it on exit */
+let createdSessionDirectory: string | undefined
+
+const getSessionDirectory = () => {
+  sessionDirectory ??= createSessionDirectory().then(
+    directory => (createdSessionDirectory = directory),
+    e => {
+      sessionDirectory = undefined
+      throw e
+    }
+  )
+
+  return sessionDirectory
+}
+
+const createHooksDirectory = async (hooks: ReadonlyArray<string>) => {
+  const ext = __WIN32__ ? '.exe' : ''
+  const hookShimPath = getDesktopHookShimPath()
+  const session = await getSessionDirectory()
+
+  // Temporary directories might be cleaned up behind our back
+  await mkdir(session, { recursive: true })
+  const directory = await mkdtemp(join(session, 'hooks-'))
+
+  for (const hook of hooks) {
+    const hookPath = join(directory, `${hook}${ext}`)
+
+    // Creating symbolic links on Windows requires special privileges, but hard
+    // links are just as cheap. Only copy the shim as a last resort (e.g. if
+    // the temporary directory is in a different volume).
+    if (__WIN32__) {
+      await link(hookShimPath, hookPath).catch(() => cp(hookShimPath, hookPath))
+    } else {
+      await symlink(hookShimPath, hookPath)
+    }
+  }
+
+  return directory
+}
+
+const getHooksDirectory = async (
+  hooks: ReadonlyArray<string>
+): Promise<string> => {
+  const key = [...hooks].sort().join('\0')
+  const existing = hooksDirectories.get(key)
+
+  if (existing !== undefined) {
+    const directory = await existing.catch(() => undefined)
+
+    // Temporary directories might be cleaned up behind our back
+    if (directory !== undefined && (await stat(directory).catch(() => null))) {
+      return directory
+    }
+
+    if (hooksDirectories.get(key) === existing) {
+      hooksDirectories.delete(key)
+    }
+
+    return getHooksDirectory(hooks)
+  }
+
+  const directory = createHooksDirectory(hooks)
+  hooksDirectories.set(key, directory)
+  return directory
+}
+
+process.once('exit', () => {
+  if (createdSessionDirectory !== undefined) {
+    rmSync(createdSessionDirectory, { recursive: true, force: true })
+  }
+})
+
 export async function withHooksEnv<T>(
   fn: (env: Record<string, string | undefined> | undefined) => Promise<T>,
   path: string,
@@ -41,32 +196,28 @@ export async function withHooksEnv<T>(
     return fn(opts?.env)
   }
 
-  const ext = __WIN32__ ? '.exe' : ''
-  const processProxyPath = join(__dirname, `process-proxy${ext}`)
-
   const token = crypto.randomUUID()
-  const tmpHooksDir = await mkdtemp(join(tmpdir(), 'desktop-git-hooks-'))
+  const hooksDir = await getHooksDirectory(hooks)
   const hooksProxy = createHooksProxy(
     cwd =>
-      memoizedGetShellEnv(
-        getGitHookEnvShell(),
-        cwd,
-        // We always cache environment per token (i.e. per operation, e.g commit, apply, etc)
-        // but we can optionally cache it over multiple operations in the same repository if the user
-        // has enabled that setting.
-        getCacheHooksEnv() ? 'global' : token
-      ),
+      // We always cache environment per token (i.e. per operation, e.g commit,
+      // apply, etc) but if the user has enabled caching the environment over
+      // multiple operations we use a resident shell per repository instead,
+      // which gets rebuilt when the shell configuration changes.
+      getCacheHooksEnv()
+        ? getResidentShellEnv(cwd, getGitHookEnvShell())
+        : memoizedGetShellEnv(getGitHookEnvShell(), cwd, token),
     opts?.onHookProgress,
     opts?.onHookFailure
   )
 
-  const server = createProxyProcessServer(
+  const server = createHookShimServer(
     conn =>
       hooksProxy(conn).catch(err => {
         log.error(`hooks proxy failed:`, err)
         conn.exit(1).catch(() => {})
       }),
-    { validateConnection: async receivedToken => receivedToken === token }
+    receivedToken => receivedToken === token
   )
   const port = await new Promise<number>(resolve => {
     server.listen(0, '127.0.0.1', () =>
@@ -74,10 +225,6 @@ export async function withHooksEnv<T>(
     )
   })
   try {
-    for (const hook of hooks) {
-      await cp(processProxyPath, join(tmpHooksDir, `${hook}${ext}`))
-    }
-
     const existingGitEnvConfig =
       opts?.env?.['GIT_CONFIG_PARAMETERS'] ??
       process.env['GIT_CONFIG_PARAMETERS'] ??
@@ -87,17 +234,13 @@ export async function withHooksEnv<T>(
       existingGitEnvConfig.length > 0 ? `${existingGitEnvConfig} ` : ''
 
     return await fn({
-      // TODO: Do we need to escape tmpHooksDir? Could it possibly include a single quote?
+      // TODO: Do we need to escape hooksDir? Could it possibly include a single quote?
       // probably not?
-      GIT_CONFIG_PARAMETERS: `${gitEnvConfigPrefix}'core.hooksPath=${tmpHooksDir}'`,
-      PROCESS_PROXY_PORT: `${port}`,
-      PROCESS_PROXY_TOKEN: token,
+      GIT_CONFIG_PARAMETERS: `${gitEnvConfigPrefix}'core.hooksPath=${hooksDir}'`,
+      DESKTOP_HOOK_PORT: `${port}`,
+      DESKTOP_HOOK_TOKEN: token,
     })
   } finally {
     server.close()
-    // Clean up the temporary directory
-    await rm(tmpHooksDir, { recursive: true, force: true }).catch(() => {
-      // Ignore errors
-    })
   }
 }
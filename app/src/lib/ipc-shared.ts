@@ -14,7 +14,10 @@ import { EndpointToken } from './endpoint-token'
 import { PathType } from '../ui/lib/app-proxy'
 import { ThemeSource } from '../ui/lib/theme-source'
 import { DesktopNotificationPermission } from 'desktop-notifications'
-import { NotificationCallback } from 'desktop-notifications'
+import {
+  IShowNotificationOptions,
+  NotificationCallback,
+} from 'desktop-notifications'
 import { DesktopAliveEvent } from './stores/alive-store'
 import { CLIAction } from './cli-action'
 
@@ -131,7 +134,8 @@ export type RequestResponseChannels = {
   'show-notification': (
     title: string,
     body: string,
-    userInfo?: DesktopAliveEvent
+    userInfo?: DesktopAliveEvent,
+    options?: IShowNotificationOptions
   ) => Promise<string | null>
   'get-notifications-permission': () => Promise<DesktopNotificationPermission>
   'request-notifications-permission': () => Promise<boolean>
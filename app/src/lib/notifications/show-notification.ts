@@ -9,6 +9,18 @@ interface IShowNotificationOptions {
   body: string
   userInfo?: DesktopAliveEvent
   onClick: () => void
+
+  /**
+   * ID of the notification. A notification with the same ID as a previous one
+   * replaces it, whether it was already displayed or not.
+   */
+  id?: string
+
+  /**
+   * Notifications of the same group replace each other while they're waiting
+   * to be displayed, so that a burst of them only displays the latest one.
+   */
+  group?: string
 }
 
 /**
@@ -21,6 +33,7 @@ export async function showNotification(options: IShowNotificationOptions) {
   if (!supportsNotifications()) {
     const notification = new Notification(options.title, {
       body: options.body,
+      tag: options.id,
     })
 
     notification.onclick = () => {
@@ -33,7 +46,8 @@ export async function showNotification(options: IShowNotificationOptions) {
   const notificationID = await invokeShowNotification(
     options.title,
     options.body,
-    options.userInfo
+    options.userInfo,
+    { id: options.id, group: options.group }
   )
   if (notificationID !== null) {
     notificationCallbacks.set(notificationID, options.onClick)
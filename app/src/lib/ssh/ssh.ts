@@ -1,6 +1,9 @@
+import { spawn } from 'child_process'
+import { mkdtemp } from 'fs/promises'
+import { join } from 'path'
 import memoizeOne from 'memoize-one'
 import { pathExists } from '../../ui/lib/path-exists'
-import { getBoolean } from '../local-storage'
+import { getBoolean, setBoolean } from '../local-storage'
 import {
   getDesktopAskpassTrampolinePath,
   getSSHWrapperPath,
@@ -10,6 +13,12 @@ const WindowsOpenSSHPath = 'C:/Windows/System32/OpenSSH/ssh.exe'
 
 export const UseWindowsOpenSSHKey: string = 'useWindowsOpenSSH'
 
+export const UseSSHConnectionMultiplexingKey: string =
+  'useSSHConnectionMultiplexing'
+
+/** How long (in seconds) idle SSH master connections are kept around */
+const SSHControlPersistSeconds = 300
+
 export const isWindowsOpenSSHAvailable = memoizeOne(
   async (): Promise<boolean> => {
     if (!__WIN32__) {
@@ -37,11 +46,127 @@ function isWindowsOpenSSHUseEnabled() {
   }
 }
 
+/** Whether the user enabled SSH connection multiplexing in the preferences */
+export function getUseSSHConnectionMultiplexing() {
+  try {
+    return getBoolean(UseSSHConnectionMultiplexingKey, false)
+  } catch (e) {
+    return false
+  }
+}
+
+export function setUseSSHConnectionMultiplexing(enabled: boolean) {
+  setBoolean(UseSSHConnectionMultiplexingKey, enabled)
+}
+
+/**
+ * Closes the SSH master connections and removes the directory with their
+ * control sockets. This is done from a detached shell so quitting the app
+ * doesn't have to wait for it, and if it doesn't work out, masters exit on
+ * their own after being idle for ControlPersist seconds anyway.
+ */
+function closeSSHMasterConnections(directory: string) {
+  // The host is required but ignored, the control socket is all that matters
+  // to reach the master.
+  const script =
+    'for socket in "$1"/*; do ' +
+    '[ -S "$socket" ] && ssh -S "$socket" -O exit desktop; ' +
+    'done; rm -rf "$1"'
+
+  try {
+    spawn('/bin/sh', ['-c', script, 'sh', directory], {
+      detached: true,
+      stdio: 'ignore',
+    }).unref()
+  } catch (e) {
+    // Nothing else to do, the app is quitting
+  }
+}
+
+/**
+ * Returns the private directory where the control sockets of SSH master
+ * connections live, creating it the first time. It's removed when the app
+ * exits.
+ */
+let sshControlDirectory: Promise<string> | null = null
+
+function getSSHControlDirectory() {
+  if (sshControlDirectory === null) {
+    // Control socket paths must fit in a sockaddr_un (only 104 bytes on
+    // macOS), which is why this doesn't use the much longer per-user temporary
+    // directory on macOS. mkdtemp makes it accessible to the current user only.
+    const directory = mkdtemp('/tmp/desktop-ssh-').then(d => {
+      // Quitting doesn't always get as far as emitting the exit event in the
+      // renderer, hence the unload listener.
+      let closed = false
+      const close = () => {
+        if (!closed) {
+          closed = true
+          closeSSHMasterConnections(d)
+        }
+      }
+
+      process.once('exit', close)
+      if (typeof window !== 'undefined') {
+        window.addEventListener('unload', close)
+      }
+
+      return d
+    })
+
+    directory.catch(() => {
+      sshControlDirectory = null
+    })
+
+    sshControlDirectory = directory
+  }
+
+  return sshControlDirectory
+}
+
+/**
+ * Returns the environment variables that enable SSH connection multiplexing
+ * in our ssh wrapper, if the user opted into it.
+ *
+ * The wrapper is set through GIT_SSH, which git only uses when neither
+ * GIT_SSH_COMMAND nor core.sshCommand are set, so an SSH command configured
+ * by the user always wins. Multiplexing is skipped altogether when the user
+ * sets either of those environment variables.
+ */
+async function getSSHMultiplexingEnvironment(
+  customEnv?: Record<string, string | undefined>
+) {
+  if (__WIN32__ || !getUseSSHConnectionMultiplexing()) {
+    return null
+  }
+
+  const env = { ...process.env, ...customEnv }
+  if (env.GIT_SSH_COMMAND || env.GIT_SSH) {
+    return null
+  }
+
+  try {
+    return {
+      GIT_SSH: getSSHWrapperPath(),
+      DESKTOP_SSH_CONTROL_DIR: await getSSHControlDirectory(),
+      DESKTOP_SSH_CONTROL_PERSIST: `${SSHControlPersistSeconds}`,
+    }
+  } catch (e) {
+    log.warn('Failed to set up SSH connection multiplexing', e)
+    return null
+  }
+}
+
 /**
  * Returns the git environment variables related to SSH depending on the current
  * context (OS and user settings).
+ *
+ * @param customEnv The environment the git operation will run with on top of
+ *                  the app's, if any.
  */
-export async function getSSHEnvironment() {
+export async function getSSHEnvironment(
+  customEnv?: Record<string, string | undefined>
+) {
   const baseEnv = {
     SSH_ASKPASS: getDesktopAskpassTrampolinePath(),
     // DISPLAY needs to be set to _something_ so ssh actually uses SSH_ASKPASS
@@ -57,6 +182,11 @@ export async function getSSHEnvironment() {
     }
   }
 
+  const multiplexingEnv = await getSSHMultiplexingEnvironment(customEnv)
+  if (multiplexingEnv !== null) {
+    return { ...baseEnv, ...multiplexingEnv }
+  }
+
   if (__DARWIN__ && __DEV__) {
     // Replace git ssh command with our wrapper in dev builds, since they are
     // launched from a command line.
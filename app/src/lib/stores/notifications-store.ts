@@ -67,6 +67,18 @@ export function getNotificationsEnabled() {
   return getBoolean(NotificationsEnabledKey, true)
 }
 
+/**
+ * Returns a key identifying notifications of the given kind for a pull request,
+ * so that newer notifications can replace older ones instead of piling up.
+ */
+function getPullRequestNotificationKey(
+  kind: string,
+  repository: RepositoryWithGitHubRepository,
+  pullRequest: PullRequest
+) {
+  return `${kind}:${repository.gitHubRepository.fullName}#${pullRequest.pullRequestNumber}`
+}
+
 /**
  * This class manages the coordination between Alive events and actual OS-level
  * notifications.
@@ -205,6 +217,12 @@ export class NotificationsStore {
       body,
       userInfo: event,
       onClick,
+      // A burst of comments only shows the latest ones
+      group: getPullRequestNotificationKey(
+        'pull-request-comment',
+        repository,
+        pullRequest
+      ),
     })
 
     this.statsStore.increment('pullRequestCommentNotificationCount')
@@ -285,6 +303,12 @@ export class NotificationsStore {
       body,
       userInfo: event,
       onClick,
+      // A burst of reviews only shows the latest ones
+      group: getPullRequestNotificationKey(
+        'pull-request-review',
+        repository,
+        pullRequest
+      ),
     })
 
     this.statsStore.recordPullRequestReviewNotificationShown(review.state)
@@ -414,6 +438,12 @@ export class NotificationsStore {
       body,
       userInfo: event,
       onClick,
+      // Only the latest failure of the pull request is relevant
+      id: getPullRequestNotificationKey(
+        'checks-failed',
+        repository,
+        pullRequest
+      ),
     })
 
     this.statsStore.increment('checksFailedNotificationCount')
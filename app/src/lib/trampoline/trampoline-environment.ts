@@ -9,7 +9,11 @@ import {
 import { GitError as DugiteError, exec } from 'dugite'
 import memoizeOne from 'memoize-one'
 import { GitError, getDescriptionForError } from '../git/core'
-import { getDesktopAskpassTrampolineFilename } from 'desktop-trampoline'
+import {
+  getDesktopAskpassTrampolineFilename,
+  getDesktopHookShimFilename,
+} from 'desktop-trampoline'
+import { TrampolineProtocolVersion } from './trampoline-frame-decoder'
 
 const hasRejectedCredentialsForEndpoint = new Map<string, Set<string>>()
 
@@ -96,7 +100,7 @@ export async function withTrampolineEnv<T>(
   isBackgroundTask = false,
   customEnv?: Record<string, string | undefined>
 ): Promise<T> {
-  const sshEnv = await getSSHEnvironment()
+  const sshEnv = await getSSHEnvironment(customEnv)
 
   return withTrampolineToken(async token => {
     isBackgroundTaskEnvironment.set(token, isBackgroundTask)
@@ -119,9 +123,13 @@ export async function withTrampolineEnv<T>(
     // With those two premises in mind, we can safely assume that right after
     // `fn` has been invoked, we can store the SSH key passphrase for this git
     // operation if there was one pending to be stored.
+    const socketPath = await trampolineServer.getSocketPath()
+
     try {
       return await fn({
         DESKTOP_PORT: await trampolineServer.getPort(),
+        ...(socketPath !== null ? { DESKTOP_SOCKET_PATH: socketPath } : {}),
+        DESKTOP_TRAMPOLINE_PROTOCOL_VERSION: `${TrampolineProtocolVersion}`,
         DESKTOP_TRAMPOLINE_TOKEN: token,
         GIT_ASKPASS: '',
         // This warrants some explanation. We're configuring the
@@ -215,6 +223,15 @@ export function getDesktopAskpassTrampolinePath(): string {
   )
 }
 
+/** Returns the path of the desktop-hook-shim binary. */
+export function getDesktopHookShimPath(): string {
+  return Path.resolve(
+    __dirname,
+    'desktop-trampoline',
+    getDesktopHookShimFilename()
+  )
+}
+
 /** Returns the path of the ssh-wrapper binary. */
 export function getSSHWrapperPath(): string {
   return Path.resolve(__dirname, 'desktop-trampoline', 'ssh-wrapper')
@@ -0,0 +1,262 @@
+import { assertNever } from '../fatal-error'
+
+/** Magic number framed trampoline requests start with. */
+const FramedRequestMagic = Buffer.from('DTRP', 'ascii')
+
+/**
+ * Version of the framed trampoline protocol supported by the app. This is
+ * advertised to the trampoline client via the
+ * DESKTOP_TRAMPOLINE_PROTOCOL_VERSION environment variable.
+ */
+export const TrampolineProtocolVersion = 2
+
+/** Size of the header (magic number + version byte) of framed requests. */
+const HeaderLength = FramedRequestMagic.length + 1
+
+/** Size of the length prefix of every field in framed requests. */
+const LengthPrefixSize = 4
+
+/**
+ * Maximum length of a single field. Length prefixes are sent by the client, so
+ * they can't be trusted to keep the data buffered while waiting for a field
+ * within reasonable bounds.
+ */
+const MaxFieldLength = 1024 * 1024
+
+/** Maximum size of a whole request, including its header and prefixes. */
+const MaxRequestLength = 16 * 1024 * 1024
+
+enum TrampolineFrameDecoderState {
+  Header,
+  ParameterCount,
+  ParameterLength,
+  Parameter,
+  EnvironmentVariablesCount,
+  EnvironmentVariableLength,
+  EnvironmentVariable,
+  StdinChunkLength,
+  StdinChunk,
+  Finished,
+}
+
+/**
+ * Whether or not the given chunk of data (the first one received from a
+ * trampoline client) belongs to a framed request. Legacy requests always start
+ * with the number of parameters as an ASCII string, so looking at the first
+ * byte is enough to tell them apart.
+ */
+export function isFramedTrampolineRequest(chunk: Buffer) {
+  return chunk.length > 0 && chunk[0] === FramedRequestMagic[0]
+}
+
+/**
+ * The purpose of this class is to decode framed requests sent by the
+ * trampoline client into the same sequence of values the legacy protocol
+ * produces, so they can be fed into a `TrampolineCommandParser`.
+ *
+ * Framed requests start with a header (magic number and protocol version),
+ * followed by fields prefixed by their length as 32-bit big-endian unsigned
+ * integers: the number of parameters and each parameter, the number of
+ * environment variables and each variable, and the standard input as a
+ * sequence of chunks terminated by an empty one.
+ */
+export class TrampolineFrameDecoder {
+  private pending = Buffer.alloc(0)
+  private offset = 0
+  private remainingFields = 0
+  private fieldLength = 0
+  private requestLength = 0
+  private readonly stdinChunks = new Array<Buffer>()
+
+  private state: TrampolineFrameDecoderState =
+    TrampolineFrameDecoderState.Header
+
+  /** Whether or not it has finished decoding the request. */
+  public hasFinished() {
+    return this.state === TrampolineFrameDecoderState.Finished
+  }
+
+  /**
+   * Takes a chunk of data and returns all the values that could be decoded
+   * with it.
+   *
+   * Throws an error if the header is invalid, the protocol version is not
+   * supported, or a field or the request are too long. Any data received after
+   * the request has finished is ignored.
+   */
+  public push(chunk: Buffer): ReadonlyArray<string> {
+    if (this.hasFinished()) {
+      return []
+    }
+
+    this.requestLength += chunk.length
+    if (this.requestLength > MaxRequestLength) {
+      throw new Error('Trampoline request is too long')
+    }
+
+    this.pending =
+      this.offset < this.pending.length
+        ? Buffer.concat([this.pending.subarray(this.offset), chunk])
+        : chunk
+    this.offset = 0
+
+    const values = new Array<string>()
+
+    while (!this.hasFinished()) {
+      const value = this.processNext()
+
+      if (value === null) {
+        break
+      }
+
+      if (value !== undefined) {
+        values.push(value)
+      }
+    }
+
+    return values
+  }
+
+  /** Returns the next `length` bytes, or null if they haven't arrived yet. */
+  private read(length: number): Buffer | null {
+    if (this.pending.length - this.offset < length) {
+      return null
+    }
+
+    const data = this.pending.subarray(this.offset, this.offset + length)
+    this.offset += length
+    return data
+  }
+
+  private readLength(): number | null {
+    const data = this.read(LengthPrefixSize)
+    return data === null ? null : data.readUInt32BE(0)
+  }
+
+  /**
+   * Processes the next field depending on the current state. Returns null if
+   * more data is needed, the decoded value if there is one, or undefined if
+   * the field didn't produce any value.
+   */
+  private processNext(): string | null | undefined {
+    switch (this.state) {
+      case TrampolineFrameDecoderState.Header: {
+        const header = this.read(HeaderLength)
+        if (header === null) {
+          return null
+        }
+
+        const magic = header.subarray(0, FramedRequestMagic.length)
+        if (!magic.equals(FramedRequestMagic)) {
+          throw new Error('Invalid trampoline request header')
+        }
+
+        const version = header[FramedRequestMagic.length]
+        if (version !== TrampolineProtocolVersion) {
+          throw new Error(`Unsupported trampoline protocol version ${version}`)
+        }
+
+        this.state = TrampolineFrameDecoderState.ParameterCount
+        return undefined
+      }
+
+      case TrampolineFrameDecoderState.ParameterCount:
+      case TrampolineFrameDecoderState.EnvironmentVariablesCount: {
+        const count = this.readLength()
+        if (count === null) {
+          return null
+        }
+
+        const isParameters =
+          this.state === TrampolineFrameDecoderState.ParameterCount
+
+        this.remainingFields = count
+
+        if (count > 0) {
+          this.state = isParameters
+            ? TrampolineFrameDecoderState.ParameterLength
+            : TrampolineFrameDecoderState.EnvironmentVariableLength
+        } else {
+          this.state = isParameters
+            ? TrampolineFrameDecoderState.EnvironmentVariablesCount
+            : TrampolineFrameDecoderState.StdinChunkLength
+        }
+
+        return count.toString()
+      }
+
+      case TrampolineFrameDecoderState.ParameterLength:
+      case TrampolineFrameDecoderState.EnvironmentVariableLength:
+      case TrampolineFrameDecoderState.StdinChunkLength: {
+        const length = this.readLength()
+        if (length === null) {
+          return null
+        }
+
+        if (length > MaxFieldLength) {
+          throw new Error(`Trampoline request field is too long (${length})`)
+        }
+
+        this.fieldLength = length
+
+        if (this.state === TrampolineFrameDecoderState.ParameterLength) {
+          this.state = TrampolineFrameDecoderState.Parameter
+        } else if (
+          this.state === TrampolineFrameDecoderState.EnvironmentVariableLength
+        ) {
+          this.state = TrampolineFrameDecoderState.EnvironmentVariable
+        } else if (length > 0) {
+          this.state = TrampolineFrameDecoderState.StdinChunk
+        } else {
+          // An empty chunk marks the end of stdin, and the request
+          this.state = TrampolineFrameDecoderState.Finished
+          return Buffer.concat(this.stdinChunks).toString('utf8')
+        }
+
+        return undefined
+      }
+
+      case TrampolineFrameDecoderState.Parameter:
+      case TrampolineFrameDecoderState.EnvironmentVariable: {
+        const data = this.read(this.fieldLength)
+        if (data === null) {
+          return null
+        }
+
+        const isParameter =
+          this.state === TrampolineFrameDecoderState.Parameter
+
+        this.remainingFields--
+
+        if (this.remainingFields > 0) {
+          this.state = isParameter
+            ? TrampolineFrameDecoderState.ParameterLength
+            : TrampolineFrameDecoderState.EnvironmentVariableLength
+        } else {
+          this.state = isParameter
+            ? TrampolineFrameDecoderState.EnvironmentVariablesCount
+            : TrampolineFrameDecoderState.StdinChunkLength
+        }
+
+        return data.toString('utf8')
+      }
+
+      case TrampolineFrameDecoderState.StdinChunk: {
+        const data = this.read(this.fieldLength)
+        if (data === null) {
+          return null
+        }
+
+        this.stdinChunks.push(data)
+        this.state = TrampolineFrameDecoderState.StdinChunkLength
+        return undefined
+      }
+
+      case TrampolineFrameDecoderState.Finished:
+        return null
+
+      default:
+        return assertNever(this.state, `Invalid state: ${this.state}`)
+    }
+  }
+}
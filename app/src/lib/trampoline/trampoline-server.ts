@@ -1,4 +1,7 @@
 import { createServer, AddressInfo, Server, Socket } from 'net'
+import { mkdtemp, rm } from 'fs/promises'
+import { tmpdir } from 'os'
+import { join } from 'path'
 import split2 from 'split2'
 import { sendNonFatalException } from '../helpers/non-fatal-exception'
 import {
@@ -7,6 +10,10 @@ import {
   TrampolineCommandIdentifier,
 } from './trampoline-command'
 import { TrampolineCommandParser } from './trampoline-command-parser'
+import {
+  isFramedTrampolineRequest,
+  TrampolineFrameDecoder,
+} from './trampoline-frame-decoder'
 import { isValidTrampolineToken } from './trampoline-tokens'
 
 /**
@@ -22,10 +29,19 @@ import { isValidTrampolineToken } from './trampoline-tokens'
  * instead of reacting to errors with an immediate retry, the server will remain
  * closed until the next time the app needs it (i.e. in the next git remote
  * operation).
+ *
+ * Besides the TCP port, on platforms other than Windows the server will also
+ * listen on a Unix domain socket inside a private temporary directory. The
+ * trampoline client prefers that socket (via DESKTOP_SOCKET_PATH) since it's
+ * cheaper to connect to and can't be blocked by firewalls or antivirus
+ * software, and falls back to the TCP port if it can't use it.
  */
 export class TrampolineServer {
   private readonly server: Server
+  private readonly unixServer: Server | null
   private listeningPromise: Promise<void> | null = null
+  private socketDirectory: string | null = null
+  private socketPath: string | null = null
 
   private readonly commandHandlers = new Map<
     TrampolineCommandIdentifier,
@@ -41,10 +57,17 @@ export class TrampolineServer {
     // suite runner would never finish, hitting a 45min timeout for the whole
     // GitHub Action.
     this.server.unref()
+
+    if (__WIN32__) {
+      this.unixServer = null
+    } else {
+      this.unixServer = createServer(socket => this.onNewConnection(socket))
+      this.unixServer.unref()
+    }
   }
 
   private async listen(): Promise<void> {
-    this.listeningPromise = new Promise((resolve, reject) => {
+    this.listeningPromise = new Promise<void>((resolve, reject) => {
       // Observe errors while trying to start the server
       this.server.on('error', error => {
         reject(error)
@@ -58,11 +81,59 @@ export class TrampolineServer {
 
         resolve()
       })
-    })
+    }).then(() => this.listenOnUnixSocket())
 
     return this.listeningPromise
   }
 
+  /**
+   * Starts listening on a Unix domain socket. Failing to do so is not fatal:
+   * the trampoline client will just use the TCP port instead.
+   */
+  private async listenOnUnixSocket(): Promise<void> {
+    const server = this.unixServer
+    if (server === null) {
+      return
+    }
+
+    try {
+      // mkdtemp creates the directory with 0700 permissions, so only the
+      // current user will be able to connect to the socket.
+      const directory = await mkdtemp(join(tmpdir(), 'desktop-trampoline-'))
+      this.socketDirectory = directory
+
+      const path = join(directory, 'socket')
+
+      await new Promise<void>((resolve, reject) => {
+        server.once('error', reject)
+        server.listen(path, () => {
+          server.removeListener('error', reject)
+          server.on('error', this.onUnixServerError)
+          resolve()
+        })
+      })
+
+      this.socketPath = path
+    } catch (e) {
+      log.warn('Could not start trampoline Unix socket server', e)
+      await this.closeUnixSocket()
+    }
+  }
+
+  private async closeUnixSocket() {
+    this.socketPath = null
+    this.unixServer?.close()
+    this.unixServer?.removeAllListeners('error')
+
+    if (this.socketDirectory !== null) {
+      const directory = this.socketDirectory
+      this.socketDirectory = null
+      await rm(directory, { recursive: true, force: true }).catch(e =>
+        log.warn('Could not remove trampoline socket directory', e)
+      )
+    }
+  }
+
   private async close() {
     // Make sure the server is not trying to start
     if (this.listeningPromise !== null) {
@@ -72,6 +143,7 @@ export class TrampolineServer {
     // Reset the server, it will be restarted lazily the next time it's needed
     this.server.close()
     this.server.removeAllListeners('error')
+    await this.closeUnixSocket()
     this.listeningPromise = null
   }
 
@@ -96,6 +168,18 @@ export class TrampolineServer {
     return this.port
   }
 
+  /**
+   * This function will retrieve the path of the Unix domain socket the server
+   * is listening on, or null if it's not available (e.g. on Windows or if the
+   * socket couldn't be created).
+   *
+   * Like `getPort`, it might need to start the server if it's not running.
+   */
+  public async getSocketPath(): Promise<string | null> {
+    await this.getPort()
+    return this.socketPath
+  }
+
   private get port(): number | null {
     const address = this.server.address() as AddressInfo
 
@@ -109,21 +193,56 @@ export class TrampolineServer {
   private onNewConnection(socket: Socket) {
     const parser = new TrampolineCommandParser()
 
-    // Messages coming from the trampoline client will be separated by \0
-    socket.pipe(split2(/\0/)).on('data', data => {
-      this.onDataReceived(socket, parser, data)
+    // The first chunk of data tells us which protocol the client speaks
+    socket.once('data', (chunk: Buffer) => {
+      if (isFramedTrampolineRequest(chunk)) {
+        const decoder = new TrampolineFrameDecoder()
+        const onChunk = (data: Buffer) =>
+          this.onFramedDataReceived(socket, decoder, parser, data)
+
+        socket.on('data', onChunk)
+        onChunk(chunk)
+      } else {
+        // Messages coming from legacy trampoline clients will be separated
+        // by \0
+        const splitter = split2(/\0/)
+        splitter.on('data', (data: Buffer) => {
+          this.onValueReceived(socket, parser, data.toString('utf8'))
+        })
+        splitter.write(chunk)
+        socket.pipe(splitter)
+      }
     })
 
     socket.on('error', this.onClientError)
   }
 
-  private onDataReceived(
+  private onFramedDataReceived(
     socket: Socket,
+    decoder: TrampolineFrameDecoder,
     parser: TrampolineCommandParser,
     data: Buffer
   ) {
-    const value = data.toString('utf8')
+    let values: ReadonlyArray<string>
 
+    try {
+      values = decoder.push(data)
+    } catch (error) {
+      log.error('Error decoding trampoline data', error)
+      socket.end()
+      return
+    }
+
+    for (const value of values) {
+      this.onValueReceived(socket, parser, value)
+    }
+  }
+
+  private onValueReceived(
+    socket: Socket,
+    parser: TrampolineCommandParser,
+    value: string
+  ) {
     try {
       parser.processValue(value)
     } catch (error) {
@@ -187,6 +306,11 @@ export class TrampolineServer {
     this.close()
   }
 
+  private onUnixServerError = (error: Error) => {
+    log.error('Trampoline Unix socket server error', error)
+    this.closeUnixSocket()
+  }
+
   private onClientError = (error: Error) => {
     log.error('Trampoline client error', error)
   }
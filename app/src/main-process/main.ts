@@ -678,8 +678,10 @@ app.on('ready', () => {
 
   ipcMain.handle('save-guid', (_, guid) => saveGUIDFile(guid))
 
-  ipcMain.handle('show-notification', async (_, title, body, userInfo) =>
-    showNotification(title, body, userInfo)
+  ipcMain.handle(
+    'show-notification',
+    async (_, title, body, userInfo, options) =>
+      showNotification(title, body, userInfo, options)
   )
 
   ipcMain.handle('get-notifications-permission', async () =>
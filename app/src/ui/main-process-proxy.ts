@@ -383,7 +383,7 @@ export const saveGUID = invokeProxy('save-guid', 1)
 export const getGUID = invokeProxy('get-guid', 0)
 
 /** Tell the main process to show a notification */
-export const showNotification = invokeProxy('show-notification', 3)
+export const showNotification = invokeProxy('show-notification', 4)
 
 /** Tell the main process to obtain the app's permission to display notifications */
 export const getNotificationsPermission = invokeProxy(
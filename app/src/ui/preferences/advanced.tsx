@@ -8,10 +8,12 @@ import { t } from 'i18next'
 
 interface IAdvancedPreferencesProps {
   readonly useWindowsOpenSSH: boolean
+  readonly useSSHConnectionMultiplexing: boolean
   readonly optOutOfUsageTracking: boolean
   readonly useExternalCredentialHelper: boolean
   readonly repositoryIndicatorsEnabled: boolean
   readonly onUseWindowsOpenSSHChanged: (checked: boolean) => void
+  readonly onUseSSHConnectionMultiplexingChanged: (checked: boolean) => void
   readonly onOptOutofReportingChanged: (checked: boolean) => void
   readonly onUseExternalCredentialHelperChanged: (checked: boolean) => void
   readonly onRepositoryIndicatorsEnabledChanged: (enabled: boolean) => void
@@ -75,6 +77,14 @@ export class Advanced extends React.Component<
     this.props.onUseWindowsOpenSSHChanged(event.currentTarget.checked)
   }
 
+  private onUseSSHConnectionMultiplexingChanged = (
+    event: React.FormEvent<HTMLInputElement>
+  ) => {
+    this.props.onUseSSHConnectionMultiplexingChanged(
+      event.currentTarget.checked
+    )
+  }
+
   private reportDesktopUsageLabel() {
     return (
       <span>
@@ -185,6 +195,41 @@ export class Advanced extends React.Component<
   }
 
   private renderSSHSettings() {
+    // Connection multiplexing relies on OpenSSH's control sockets, which
+    // aren't supported on Windows.
+    if (!__WIN32__) {
+      return (
+        <div className="advanced-section">
+          <Checkbox
+            label={t(
+              'advanced.use-ssh-connection-multiplexing',
+              'Reuse SSH connections'
+            )}
+            value={
+              this.props.useSSHConnectionMultiplexing
+                ? CheckboxValue.On
+                : CheckboxValue.Off
+            }
+            onChange={this.onUseSSHConnectionMultiplexingChanged}
+            ariaDescribedBy="use-ssh-connection-multiplexing-description"
+          />
+          <div
+            id="use-ssh-connection-multiplexing-description"
+            className="git-settings-description"
+          >
+            <p>
+              {t(
+                'advanced.use-ssh-connection-multiplexing-description',
+                `Share one SSH connection between consecutive Git operations on
+                the same host to make them faster. This is not used when you
+                configure your own SSH command.`
+              )}
+            </p>
+          </div>
+        </div>
+      )
+    }
+
     if (!this.state.canUseWindowsSSH) {
       return null
     }
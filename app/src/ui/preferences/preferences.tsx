@@ -59,6 +59,10 @@ import {
   setGitHookEnvShell,
   setHooksEnvEnabled,
 } from '../../lib/hooks/config'
+import {
+  getUseSSHConnectionMultiplexing,
+  setUseSSHConnectionMultiplexing,
+} from '../../lib/ssh/ssh'
 
 interface IPreferencesProps {
   readonly dispatcher: Dispatcher
@@ -154,6 +158,7 @@ interface IPreferencesState {
   readonly selectedGitTabIndex?: number
   readonly enableGitHookEnv: boolean | undefined
   readonly cacheGitHookEnv: boolean | undefined
+  readonly useSSHConnectionMultiplexing: boolean
   readonly selectedGitHookEnvShell: string | undefined
   // Whether the preferences related to Git hooks environment have been changed
   readonly hooksPreferencesDirty: boolean
@@ -221,6 +226,7 @@ export class Preferences extends React.Component<
       showDiffCheckMarks: this.props.showDiffCheckMarks,
       enableGitHookEnv: getHooksEnvEnabled(),
       cacheGitHookEnv: getCacheHooksEnv(),
+      useSSHConnectionMultiplexing: getUseSSHConnectionMultiplexing(),
       selectedGitHookEnvShell: getGitHookEnvShell(),
       hooksPreferencesDirty: false,
     }
@@ -599,10 +605,16 @@ export class Preferences extends React.Component<
         View = (
           <Advanced
             useWindowsOpenSSH={this.state.useWindowsOpenSSH}
+            useSSHConnectionMultiplexing={
+              this.state.useSSHConnectionMultiplexing
+            }
             optOutOfUsageTracking={this.state.optOutOfUsageTracking}
             useExternalCredentialHelper={this.state.useExternalCredentialHelper}
             repositoryIndicatorsEnabled={this.state.repositoryIndicatorsEnabled}
             onUseWindowsOpenSSHChanged={this.onUseWindowsOpenSSHChanged}
+            onUseSSHConnectionMultiplexingChanged={
+              this.onUseSSHConnectionMultiplexingChanged
+            }
             onOptOutofReportingChanged={this.onOptOutofReportingChanged}
             onUseExternalCredentialHelperChanged={
               this.onUseExternalCredentialHelperChanged
@@ -657,6 +669,12 @@ export class Preferences extends React.Component<
     this.setState({ useWindowsOpenSSH })
   }
 
+  private onUseSSHConnectionMultiplexingChanged = (
+    useSSHConnectionMultiplexing: boolean
+  ) => {
+    this.setState({ useSSHConnectionMultiplexing })
+  }
+
   private onShowCommitLengthWarningChanged = (
     showCommitLengthWarning: boolean
   ) => {
@@ -884,6 +902,7 @@ export class Preferences extends React.Component<
     }
 
     dispatcher.setUseWindowsOpenSSH(this.state.useWindowsOpenSSH)
+    setUseSSHConnectionMultiplexing(this.state.useSSHConnectionMultiplexing)
     dispatcher.setShowCommitLengthWarning(this.state.showCommitLengthWarning)
     dispatcher.setNotificationsEnabled(this.state.notificationsEnabled)
 
@@ -1,8 +1,12 @@
 import { describe, it } from 'node:test'
 import assert from 'node:assert'
-import { getShellEnv } from '../../src/lib/hooks/get-shell-env'
+import {
+  getShellEnv,
+  parsePrintenvzOutput,
+} from '../../src/lib/hooks/get-shell-env'
 import { SupportedHooksEnvShell } from '../../src/lib/hooks/config'
 import { getPrintenvzPath } from 'printenvz'
+import { execFileSync } from 'child_process'
 
 describe('getShellEnv', () => {
   const shellKinds: ReadonlyArray<SupportedHooksEnvShell | undefined> =
@@ -32,4 +36,50 @@ describe('getShellEnv', () => {
       )
     })
   }
+
+  it('reuses the environment when it has not changed', async () => {
+    const first = await getShellEnv(undefined, undefined, getPrintenvzPath())
+    const second = await getShellEnv(undefined, undefined, getPrintenvzPath())
+
+    assert.equal(first.kind, 'success')
+    assert.equal(second.kind, 'success')
+
+    if (first.kind !== 'success' || second.kind !== 'success') {
+      return
+    }
+
+    assert.deepEqual(first.env, second.env)
+
+    // Changes made by one caller must not leak into later results
+    first.env.DESKTOP_MUTATED_ENV = '1'
+    const third = await getShellEnv(undefined, undefined, getPrintenvzPath())
+
+    assert.equal(third.kind, 'success')
+    if (third.kind === 'success') {
+      assert.equal(third.env.DESKTOP_MUTATED_ENV, undefined)
+    }
+  })
+})
+
+describe('parsePrintenvzOutput', () => {
+  const getFrame = (env: Record<string, string>) =>
+    execFileSync(getPrintenvzPath(), ['--framed'], { env })
+
+  it('skips output written before the frame', () => {
+    const frame = getFrame({ FOO: 'bar=baz', EMPTY: '' })
+    const output = Buffer.concat([Buffer.from('hello\0world\n'), frame])
+
+    const result = parsePrintenvzOutput(output)
+
+    assert.notEqual(result, null)
+    assert.equal(result?.end, output.length)
+    assert.equal(result?.env.FOO, 'bar=baz')
+    assert.equal(result?.env.EMPTY, '')
+  })
+
+  it('returns null when the frame is incomplete', () => {
+    const frame = getFrame({ FOO: 'bar' })
+
+    assert.equal(parsePrintenvzOutput(frame.subarray(0, frame.length - 1)), null)
+  })
 })
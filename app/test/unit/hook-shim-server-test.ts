@@ -0,0 +1,76 @@
+import { describe, it } from 'node:test'
+import assert from 'node:assert'
+import { decodeHookShimRequest } from '../../src/lib/hooks/hook-shim-server'
+
+function encodeFields(fields: ReadonlyArray<string>) {
+  return Buffer.concat(
+    fields.flatMap(field => {
+      const data = Buffer.from(field, 'utf8')
+      const length = Buffer.alloc(4)
+      length.writeUInt32BE(data.length, 0)
+      return [length, data]
+    })
+  )
+}
+
+function encodeCount(count: number) {
+  const data = Buffer.alloc(4)
+  data.writeUInt32BE(count, 0)
+  return data
+}
+
+function encodeRequest(
+  args: ReadonlyArray<string>,
+  env: ReadonlyArray<string>
+) {
+  return Buffer.concat([
+    Buffer.from('DHKS\x01', 'latin1'),
+    encodeFields(['token', 'pre-commit', '/repo', '1']),
+    encodeCount(args.length),
+    encodeFields(args),
+    encodeCount(env.length),
+    encodeFields(env),
+  ])
+}
+
+describe('decodeHookShimRequest', () => {
+  it('decodes a request', () => {
+    const data = encodeRequest(
+      ['arg 1', 'ärg 2'],
+      ['GIT_DIR=.git', 'EQUALS=a=b', '=C:=C:\\']
+    )
+    const stdin = Buffer.from([0, 0, 0, 0])
+
+    const result = decodeHookShimRequest(Buffer.concat([data, stdin]))
+
+    assert.notEqual(result, null)
+    assert.equal(result?.end, data.length)
+    assert.deepEqual(result?.request, {
+      token: 'token',
+      hookName: 'pre-commit',
+      cwd: '/repo',
+      isStdinConnected: true,
+      args: ['arg 1', 'ärg 2'],
+      env: { GIT_DIR: '.git', EQUALS: 'a=b', '=C:': 'C:\\' },
+    })
+  })
+
+  it('returns null until the whole request is received', () => {
+    const data = encodeRequest(['arg'], ['GIT_DIR=.git'])
+
+    for (let length = 0; length < data.length; length++) {
+      assert.equal(decodeHookShimRequest(data.subarray(0, length)), null)
+    }
+  })
+
+  it('rejects invalid headers and unsupported versions', () => {
+    const data = encodeRequest([], [])
+
+    assert.throws(() =>
+      decodeHookShimRequest(Buffer.concat([Buffer.from('X'), data]))
+    )
+
+    data[4] = 2
+    assert.throws(() => decodeHookShimRequest(data))
+  })
+})
@@ -0,0 +1,105 @@
+import { describe, it, after } from 'node:test'
+import assert from 'node:assert'
+import { tmpdir } from 'os'
+import { chmod, mkdtemp, realpath, rm, writeFile } from 'fs/promises'
+import { join } from 'path'
+import {
+  disposeResidentShells,
+  getResidentShellEnv,
+} from '../../src/lib/hooks/resident-shell-env'
+import { getPrintenvzPath } from 'printenvz'
+
+describe('getResidentShellEnv', () => {
+  after(() => disposeResidentShells())
+
+  it('returns an env containing PATH from a reused shell', async () => {
+    for (const cwd of [process.cwd(), tmpdir()]) {
+      const result = await getResidentShellEnv(
+        cwd,
+        undefined,
+        getPrintenvzPath()
+      )
+
+      assert.equal(result.kind, 'success')
+
+      if (result.kind !== 'success') {
+        return
+      }
+
+      const pathKey = Object.keys(result.env).find(
+        k => k.toLowerCase() === 'path'
+      )
+      assert.notEqual(pathKey, undefined)
+
+      if (!__WIN32__) {
+        assert.equal(result.env.PWD, cwd)
+      }
+    }
+  })
+
+  it('serves concurrent requests', async () => {
+    const results = await Promise.all(
+      Array.from({ length: 5 }, () =>
+        getResidentShellEnv(tmpdir(), undefined, getPrintenvzPath())
+      )
+    )
+
+    for (const result of results) {
+      assert.equal(result.kind, 'success')
+    }
+  })
+
+  it(
+    'runs the shell initialization in each directory',
+    { skip: __WIN32__ },
+    async () => {
+      const root = await realpath(
+        await mkdtemp(join(tmpdir(), 'desktop-resident-shell-'))
+      )
+      const shellPath = join(root, 'shell')
+      const previousShell = process.env.SHELL
+
+      // Stands in for shell initialization that depends on the directory,
+      // like direnv or version managers do.
+      await writeFile(
+        shellPath,
+        '#!/bin/sh\nexport DESKTOP_INIT_CWD="$(pwd)"\nshift\nexec /bin/sh -c "$1"\n'
+      )
+      await chmod(shellPath, 0o755)
+
+      try {
+        process.env.SHELL = shellPath
+
+        const first = await getResidentShellEnv(
+          await realpath(await mkdtemp(join(root, 'first-'))),
+          undefined,
+          getPrintenvzPath()
+        )
+        const second = await getResidentShellEnv(
+          await realpath(await mkdtemp(join(root, 'second-'))),
+          undefined,
+          getPrintenvzPath()
+        )
+
+        assert.equal(first.kind, 'success')
+        assert.equal(second.kind, 'success')
+
+        if (first.kind !== 'success' || second.kind !== 'success') {
+          return
+        }
+
+        assert.equal(first.env.DESKTOP_INIT_CWD, first.env.PWD)
+        assert.equal(second.env.DESKTOP_INIT_CWD, second.env.PWD)
+        assert.notEqual(first.env.DESKTOP_INIT_CWD, second.env.DESKTOP_INIT_CWD)
+      } finally {
+        if (previousShell === undefined) {
+          delete process.env.SHELL
+        } else {
+          process.env.SHELL = previousShell
+        }
+        await disposeResidentShells()
+        await rm(root, { recursive: true, force: true })
+      }
+    }
+  )
+})
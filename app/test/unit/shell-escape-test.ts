@@ -0,0 +1,33 @@
+import { describe, it } from 'node:test'
+import assert from 'node:assert'
+import { bash, cmd, powershell } from '../../src/lib/hooks/shell-escape'
+
+describe('shell-escape', () => {
+  it('quotes a command with arguments for bash', () => {
+    assert.equal(
+      bash.quoteCommand("/tmp/it's here/printenvz", '--framed'),
+      `'/tmp/it'\\''s here/printenvz' '--framed'`
+    )
+  })
+
+  it('quotes a command with arguments for cmd', () => {
+    assert.equal(
+      cmd.quoteCommand('C:\\Program Files\\printenvz.exe', '--framed'),
+      '""C:\\Program Files\\printenvz.exe" "--framed""'
+    )
+  })
+
+  it('quotes a command without arguments for PowerShell', () => {
+    assert.equal(
+      powershell.quoteCommand('C:\\Program Files\\printenvz.exe'),
+      "Start-Process -NoNewWindow -Wait -FilePath 'C:\\Program Files\\printenvz.exe'"
+    )
+  })
+
+  it('quotes a command with arguments for PowerShell', () => {
+    assert.equal(
+      powershell.quoteCommand("C:\\it's here\\printenvz.exe", '--framed'),
+      "Start-Process -NoNewWindow -Wait -FilePath 'C:\\it''s here\\printenvz.exe' -ArgumentList '--framed'"
+    )
+  })
+})
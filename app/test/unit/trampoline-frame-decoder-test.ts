@@ -0,0 +1,103 @@
+import { describe, it } from 'node:test'
+import assert from 'node:assert'
+import {
+  isFramedTrampolineRequest,
+  TrampolineFrameDecoder,
+} from '../../src/lib/trampoline/trampoline-frame-decoder'
+
+function encodeField(value: string | Buffer) {
+  const data = typeof value === 'string' ? Buffer.from(value, 'utf8') : value
+  const length = Buffer.alloc(4)
+  length.writeUInt32BE(data.length)
+  return Buffer.concat([length, data])
+}
+
+function encodeCount(count: number) {
+  const data = Buffer.alloc(4)
+  data.writeUInt32BE(count)
+  return data
+}
+
+function encodeRequest(
+  parameters: ReadonlyArray<string>,
+  env: ReadonlyArray<string>,
+  stdinChunks: ReadonlyArray<string>,
+  version = 2
+) {
+  return Buffer.concat([
+    Buffer.from('DTRP', 'ascii'),
+    Buffer.from([version]),
+    encodeCount(parameters.length),
+    ...parameters.map(encodeField),
+    encodeCount(env.length),
+    ...env.map(encodeField),
+    ...stdinChunks.map(encodeField),
+    encodeCount(0),
+  ])
+}
+
+describe('TrampolineFrameDecoder', () => {
+  it('tells framed requests apart from legacy ones', () => {
+    assert.equal(isFramedTrampolineRequest(encodeRequest([], [], [])), true)
+    assert.equal(isFramedTrampolineRequest(Buffer.from('1\0get\0')), false)
+  })
+
+  it('decodes a request into the legacy sequence of values', () => {
+    const decoder = new TrampolineFrameDecoder()
+    const values = decoder.push(
+      encodeRequest(
+        ['get', 'ünïcödé'],
+        ['DESKTOP_TRAMPOLINE_IDENTIFIER=CREDENTIALHELPER'],
+        ['protocol=https\n', 'host=github.com\n']
+      )
+    )
+
+    assert.deepEqual(values, [
+      '2',
+      'get',
+      'ünïcödé',
+      '1',
+      'DESKTOP_TRAMPOLINE_IDENTIFIER=CREDENTIALHELPER',
+      'protocol=https\nhost=github.com\n',
+    ])
+    assert.equal(decoder.hasFinished(), true)
+  })
+
+  it('decodes requests split across arbitrary chunks', () => {
+    const request = encodeRequest(['a', ''], [], ['x'.repeat(10000)])
+    const decoder = new TrampolineFrameDecoder()
+    const values = new Array<string>()
+
+    for (let offset = 0; offset < request.length; offset += 3) {
+      values.push(...decoder.push(request.subarray(offset, offset + 3)))
+    }
+
+    assert.deepEqual(values, ['2', 'a', '', '0', 'x'.repeat(10000)])
+    assert.equal(decoder.hasFinished(), true)
+  })
+
+  it('rejects unsupported protocol versions', () => {
+    const decoder = new TrampolineFrameDecoder()
+    assert.throws(() => decoder.push(encodeRequest([], [], [], 3)))
+  })
+
+  it('rejects fields longer than the maximum length', () => {
+    const decoder = new TrampolineFrameDecoder()
+    const request = Buffer.concat([
+      Buffer.from('DTRP', 'ascii'),
+      Buffer.from([2]),
+      encodeCount(1),
+      encodeCount(0xffffffff),
+    ])
+
+    assert.throws(() => decoder.push(request), /too long/)
+  })
+
+  it('rejects requests longer than the maximum length', () => {
+    const decoder = new TrampolineFrameDecoder()
+    const chunk = 'x'.repeat(1024 * 1024)
+    const request = encodeRequest([], [], new Array(17).fill(chunk))
+
+    assert.throws(() => decoder.push(request), /too long/)
+  })
+})
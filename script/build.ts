@@ -7,7 +7,6 @@ import frontMatter from 'front-matter'
 import * as os from 'os'
 import * as path from 'path'
 import { getPrintenvzPath } from 'printenvz'
-import { getProxyCommandPath } from 'process-proxy'
 import { externals } from '../app/webpack.common'
 
 interface IChooseALicense {
@@ -339,6 +338,15 @@ function copyDependencies() {
     { recursive: true, verbatimSymlinks: true }
   )
 
+  console.log('  Copying desktop-hook-shim…')
+  const desktopHookShimFile =
+    process.platform === 'win32' ? 'desktop-hook-shim.exe' : 'desktop-hook-shim'
+  cpSync(
+    path.resolve(trampolineSource, desktopHookShimFile),
+    path.resolve(desktopTrampolineDir, desktopHookShimFile),
+    { recursive: true, verbatimSymlinks: true }
+  )
+
   if (isNonProductionRelease) {
     console.log('  Copying copilot…')
     const copilotPkgDir = path.resolve(
@@ -390,8 +398,9 @@ function copyDependencies() {
     }
   }
 
-  // Dev builds for macOS require a SSH wrapper to use SSH_ASKPASS
-  if (process.platform === 'darwin' && isDevelopmentBuild) {
+  // Dev builds for macOS require a SSH wrapper to use SSH_ASKPASS, and it's
+  // also used on macOS and Linux for SSH connection multiplexing.
+  if (process.platform !== 'win32') {
     console.log('  Copying ssh-wrapper')
     const sshWrapperFile = 'ssh-wrapper'
     cpSync(
@@ -447,16 +456,6 @@ function copyDependencies() {
     )
   }
 
-  console.log('  Copying process-proxy binary')
-  cpSync(
-    getProxyCommandPath(),
-    path.resolve(
-      outRoot,
-      process.platform === 'win32' ? 'process-proxy.exe' : 'process-proxy'
-    ),
-    { recursive: true, verbatimSymlinks: true }
-  )
-
   console.log('  Copying printenvz binary')
   cpSync(
     getPrintenvzPath(),